@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Scaling benchmark for either program.
+# Runs the command for every size and thread count, throws away the warmup
+# runs, and prints a tab separated table of the median metric with speedup and
+# efficiency against the smallest thread count, like matrix-determinant/Time.txt.
+# {size} and {threads} in the command are replaced for each run.
+# The metric is the number after the -m prefix at the start of an output line.
+# By default it is the time from the "Time:" or "Elapsed time =" line, which
+# only means something for programs that do a fixed amount of work. atsp_pth
+# always runs for 60 seconds, so measure it by throughput with -m and -u (the
+# metric is a rate, higher is better). Its city count is fixed by the CSV, so
+# -s there only labels the table.
+#
+# usage: bench.sh [-s "sizes"] [-t "threads"] [-w warmup] [-r reps] [-m "prefix" [-u]] -- command...
+# e.g.   ../common/bench.sh -s "1024 2048" -t "1 2 4 8" -- ./GaussianPThreads {size} {threads}
+#        ../common/bench.sh -s 1000 -t "1 2 4" -w 0 -r 3 -m "Tours per second:" -u -- ./atsp_pth {threads} 256
+
+sizes="1024"
+thread_counts="1 2 4 8"
+warmup=1
+reps=3
+metric=""
+rate=0
+
+while getopts "s:t:w:r:m:u" opt; do
+    case $opt in
+        s) sizes=$OPTARG ;;
+        t) thread_counts=$OPTARG ;;
+        w) warmup=$OPTARG ;;
+        r) reps=$OPTARG ;;
+        m) metric=$OPTARG ;;
+        u) rate=1 ;;
+        *) sed -n '15,17p' "$0"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+if [ $# -eq 0 ]; then
+    sed -n '15,17p' "$0"
+    exit 1
+fi
+template="$*"
+
+# prints the metric of one run, or fails if the run didn't report it
+run() {
+    command=${template//\{size\}/$1}
+    command=${command//\{threads\}/$2}
+    if [ -n "$metric" ]; then
+        value=$($command 2>/dev/null | awk -v p="$metric" 'index($0, p) == 1 {split(substr($0, length(p) + 1), f, " "); print f[1]; exit}')
+    else
+        value=$($command 2>/dev/null | awk '/^Time:/ {print $2; exit} /^Elapsed time =/ {print $4; exit}')
+    fi
+    if [ -z "$value" ]; then
+        echo "no ${metric:-time} reported by: $command" >&2
+        return 1
+    fi
+    echo "$value"
+}
+
+printf "threads\tsize\tspeedup\tefficiency\tmedian\n"
+for size in $sizes; do
+    base=""
+    base_threads=""
+    for threads in $thread_counts; do
+        for ((i = 0; i < warmup; i++)); do run "$size" "$threads" > /dev/null || exit 1; done
+        times=""
+        for ((i = 0; i < reps; i++)); do
+            value=$(run "$size" "$threads") || exit 1
+            times="$times$value"$'\n'
+        done
+        median=$(printf "%s" "$times" |
+            sort -g | awk '{t[NR] = $1} END {if (NR % 2) print t[(NR + 1) / 2]; else print (t[NR / 2] + t[NR / 2 + 1]) / 2}')
+        if [ -z "$base" ]; then
+            base=$median
+            base_threads=$threads
+        fi
+        awk -v t="$threads" -v s="$size" -v m="$median" -v b="$base" -v bt="$base_threads" -v rate="$rate" \
+            'BEGIN {sp = rate ? m / b : b / m; printf "%d\t%d\t%.2f\t%.2f\t%g\n", t, s, sp, sp * bt / t, m}'
+    done
+done
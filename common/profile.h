@@ -0,0 +1,187 @@
+/* File:     profile.h
+ *
+ * Purpose:  Per-thread hot path profiling built on timer.h.  Named
+ *           regions add up time and calls for each thread, counters
+ *           add up events, and regions can also be written out as a
+ *           Chrome trace (load the file in chrome://tracing or Perfetto).
+ *
+ * Note:     Everything compiles away unless built with -DPROFILE, so
+ *           the macros can stay in the hot loops.  Add -DPROFILE_TSC to
+ *           take timestamps from the cycle counter instead of
+ *           clock_gettime, which is cheaper for very short regions.
+ *           Set PROFILE_TRACE=<file.json> in the environment to get a
+ *           trace.  Names must be string literals.  The report goes to
+ *           stderr so it doesn't mix with the program's output.
+ *
+ * Example:
+ *    #include "../common/profile.h"
+ *    . . .
+ *    PROF_INIT(thread_count);
+ *    . . .  in thread my_rank:
+ *    PROF_START(t);
+ *    . . .
+ *    PROF_STOP(my_rank, "work", t);      // time, calls and trace event
+ *    PROF_START(w);
+ *    pthread_mutex_lock(&lock);
+ *    PROF_WAIT(my_rank, "wait lock", w); // time and calls only
+ *    PROF_COUNT(my_rank, "items", 1);
+ *    . . .
+ *    PROF_REPORT();
+ */
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include "timer.h"
+
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef PROFILE_TSC
+#include <x86intrin.h>
+#endif
+
+#define PROF_MAX_NAMES 16
+#define PROF_MAX_EVENTS 65536
+
+typedef struct {
+   const char* name;
+   double start, end;
+} prof_event;
+
+/* one per thread, padded so threads don't share cache lines */
+typedef struct {
+   const char* region[PROF_MAX_NAMES];
+   double time[PROF_MAX_NAMES];
+   long calls[PROF_MAX_NAMES];
+   int nregions;
+   const char* counter[PROF_MAX_NAMES];
+   long count[PROF_MAX_NAMES];
+   int ncounters;
+   prof_event* events;
+   int nevents;
+   char pad[64];
+} prof_thread;
+
+static prof_thread* prof_threads;
+static int prof_nthreads;
+static double prof_t0;
+static const char* prof_trace;
+#ifdef PROFILE_TSC
+static double prof_tsc_seconds;
+#endif
+
+static inline double prof_now(void) {
+#ifdef PROFILE_TSC
+   return __rdtsc()*prof_tsc_seconds;
+#else
+   double now;
+   GET_TIME(now);
+   return now;
+#endif
+}
+
+/* index of name in names, adding it if it isn't there yet */
+static inline int prof_slot(const char** names, int* n, const char* name) {
+   for (int i = 0; i < *n; i++)
+      if (names[i] == name || strcmp(names[i], name) == 0) return i;
+   if (*n == PROF_MAX_NAMES) return PROF_MAX_NAMES - 1;
+   names[*n] = name;
+   return (*n)++;
+}
+
+static void prof_init(int threads) {
+#ifdef PROFILE_TSC
+   double a, b;
+   unsigned long long ta, tb;
+   GET_TIME(a);
+   ta = __rdtsc();
+   do GET_TIME(b) while (b - a < 0.01);
+   tb = __rdtsc();
+   prof_tsc_seconds = (b - a)/(tb - ta);
+#endif
+   prof_nthreads = threads;
+   prof_threads = calloc(threads, sizeof(prof_thread));
+   prof_trace = getenv("PROFILE_TRACE");
+   if (prof_trace != NULL)
+      for (int i = 0; i < threads; i++)
+         prof_threads[i].events = malloc(PROF_MAX_EVENTS*sizeof(prof_event));
+   prof_t0 = prof_now();
+}
+
+static inline void prof_add(long rank, const char* name, double start, int trace) {
+   double end = prof_now();
+   prof_thread* p = &prof_threads[rank];
+   int i = prof_slot(p->region, &p->nregions, name);
+   p->time[i] += end - start;
+   p->calls[i]++;
+   if (trace && p->events != NULL && p->nevents < PROF_MAX_EVENTS) {
+      prof_event* e = &p->events[p->nevents++];
+      e->name = name;
+      e->start = start;
+      e->end = end;
+   }
+}
+
+static inline void prof_count(long rank, const char* name, long n) {
+   prof_thread* p = &prof_threads[rank];
+   p->count[prof_slot(p->counter, &p->ncounters, name)] += n;
+}
+
+static void prof_report(void) {
+   fprintf(stderr, "thread\tregion\tcalls\tseconds\n");
+   for (int t = 0; t < prof_nthreads; t++) {
+      prof_thread* p = &prof_threads[t];
+      for (int i = 0; i < p->nregions; i++)
+         fprintf(stderr, "%d\t%s\t%ld\t%f\n", t, p->region[i], p->calls[i], p->time[i]);
+   }
+   fprintf(stderr, "thread\tcounter\tcount\n");
+   for (int t = 0; t < prof_nthreads; t++) {
+      prof_thread* p = &prof_threads[t];
+      for (int i = 0; i < p->ncounters; i++)
+         fprintf(stderr, "%d\t%s\t%ld\n", t, p->counter[i], p->count[i]);
+   }
+
+   if (prof_trace != NULL) {
+      FILE* fp = fopen(prof_trace, "w");
+      if (fp == NULL) {
+         fprintf(stderr, "error writing %s\n", prof_trace);
+      } else {
+         int first = 1;
+         fprintf(fp, "{\"traceEvents\":[\n");
+         for (int t = 0; t < prof_nthreads; t++)
+            for (int i = 0; i < prof_threads[t].nevents; i++) {
+               prof_event* e = &prof_threads[t].events[i];
+               fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     first ? "" : ",\n", e->name, t,
+                     (e->start - prof_t0)*1e6, (e->end - e->start)*1e6);
+               first = 0;
+            }
+         fprintf(fp, "\n]}\n");
+         fclose(fp);
+      }
+   }
+   for (int t = 0; t < prof_nthreads; t++) free(prof_threads[t].events);
+   free(prof_threads);
+}
+
+#define PROF_INIT(threads)       prof_init(threads)
+#define PROF_START(t)            double t = prof_now()
+#define PROF_STOP(rank, name, t) prof_add(rank, name, t, 1)
+#define PROF_WAIT(rank, name, t) prof_add(rank, name, t, 0)
+#define PROF_COUNT(rank, name, n) prof_count(rank, name, n)
+#define PROF_REPORT()            prof_report()
+
+#else
+
+#define PROF_INIT(threads)
+#define PROF_START(t)
+#define PROF_STOP(rank, name, t)
+#define PROF_WAIT(rank, name, t)
+#define PROF_COUNT(rank, name, n)
+#define PROF_REPORT()
+
+#endif
+
+#endif
@@ -3,7 +3,10 @@
  #include <stdlib.h>
  #include <string.h>
  #include <math.h>
- #include "timer.h"
+ #include "../common/timer.h"
+ int size;
+ double ** m;
+ void apply(int pivot, int target);
  int main(int argc, char const *argv[])
 { 
     
@@ -11,12 +14,12 @@
         printf("usage:%s <size>\n",argv[0]);
         return 1;
     }
-    int size=strtol(argv[1],NULL,10);
+    size=strtol(argv[1],NULL,10);
     const char* sizestr=argv[1];
     char fname[21];
     sprintf(fname,"input/m%sx%s.bin",sizestr,sizestr);
     FILE * fp;
-    double ** m=malloc(size*sizeof(double*));
+    m=malloc(size*sizeof(double*));
     fp = fopen(fname, "r");
     if(NULL==fp){
         printf("error opening file. was size a 4-digit power of 2 or multiple of 1000 between 16 and 5000? ");
@@ -34,6 +37,14 @@
     double start, finish;
     GET_TIME(start);
     for (int pivot = 0; pivot < size; pivot++) {
+        // partial pivoting, swapping rows flips the sign
+        int best=pivot;
+        for (int r = pivot+1; r < size; r++)
+            if(fabs(m[r][pivot])>fabs(m[best][pivot])) best=r;
+        if(best!=pivot){
+            double* t=m[pivot]; m[pivot]=m[best]; m[best]=t;
+            d=-d;
+        }
         logd+=log10(fabs(m[pivot][pivot]));
         d*=m[pivot][pivot];
         for (int r = pivot+1; r < size; r++) {
@@ -57,3 +68,12 @@
     printf("Determenant: %lf\nLog(det): %lf\nTime: %f\n\n",d,logd,finish-start);
     return 0;
 }
+
+void apply(int pivot, int target){
+    // a zero pivot means the determinant is already 0
+    if(m[pivot][pivot]==0) return;
+    double mult=m[target][pivot]/m[pivot][pivot];
+            for(int c=pivot;c<size;c++){
+                m[target][c]-=m[pivot][c]*mult;
+            }
+}
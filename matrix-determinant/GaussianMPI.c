@@ -0,0 +1,252 @@
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <math.h>
+ #include <mpi.h>
+
+/* Distributed determinant with MPI.
+   The matrix is spread over a Pr x Pc grid of processes in 2D block cyclic
+   layout, global row i lives on process row (i/nb)%Pr, same for columns.
+   Each panel of nb columns is factored with partial pivoting inside its
+   process column, the pivots and the L panel go along the process rows,
+   the U block row goes down the process columns, then everyone updates
+   their part of the trailing matrix.
+   Compile: mpicc -O2 -Wall -o GaussianMPI GaussianMPI.c -lm
+   Run:     mpirun --mca btl self,vader -np <procs> ./GaussianMPI <size> [block] [grid rows] */
+
+int size, nb;
+int Pr, Pc, myrow, mycol;
+int mloc, nloc;
+double* A;
+MPI_Comm row_comm, col_comm;
+double comm_time=0;
+
+#define AT(li,lc) A[(size_t)(li)*nloc+(lc)]
+/* adds the time spent in an MPI call to comm_time */
+#define COMM(call) { double _t=MPI_Wtime(); call; comm_time+=MPI_Wtime()-_t; }
+
+int owner(int g, int P){ return (g/nb)%P; }
+int g2l(int g, int P){ return (g/(nb*P))*nb+g%nb; }
+int l2g(int l, int p, int P){ return (l/nb)*nb*P+p*nb+l%nb; }
+/* number of global indices below g that process p owns, which is also the
+   first local index at or past g */
+int local_count(int g, int p, int P){
+    int cnt=(g/(nb*P))*nb;
+    int extra=g%(nb*P)-p*nb;
+    if(extra>nb) extra=nb;
+    if(extra>0) cnt+=extra;
+    return cnt;
+}
+void swap_rows(int g1, int g2, int lc_start, int lc_end, double* buf);
+void Factor_panel(int k0, int kb, int* piv, double* logd, int* sign, int* singular);
+
+int main(int argc, char *argv[])
+{
+    int rank, procs;
+    MPI_Init(&argc,&argv);
+    MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+    MPI_Comm_size(MPI_COMM_WORLD,&procs);
+
+    if(argc<2||argc>4){
+        if(rank==0) printf("usage:%s <size> [block] [grid rows]\n",argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+    size=strtol(argv[1],NULL,10);
+    nb=argc>2?strtol(argv[2],NULL,10):64;
+    int dims[2]={0,0};
+    if(argc>3) dims[0]=strtol(argv[3],NULL,10);
+    if(nb<1||dims[0]<0||(dims[0]>0&&procs%dims[0]!=0)){
+        if(rank==0) printf("block must be at least 1 and grid rows must divide %i\n",procs);
+        MPI_Finalize();
+        return 1;
+    }
+    MPI_Dims_create(procs,2,dims);
+    Pr=dims[0];
+    Pc=dims[1];
+    myrow=rank/Pc;
+    mycol=rank%Pc;
+    MPI_Comm_split(MPI_COMM_WORLD,myrow,mycol,&row_comm);
+    MPI_Comm_split(MPI_COMM_WORLD,mycol,myrow,&col_comm);
+    mloc=local_count(size,myrow,Pr);
+    nloc=local_count(size,mycol,Pc);
+
+    // every rank reads only the rows it owns and keeps its columns of them
+    char fname[32];
+    sprintf(fname,"input/m%sx%s.bin",argv[1],argv[1]);
+    FILE * fp = fopen(fname, "r");
+    int ok=NULL!=fp;
+    MPI_Allreduce(MPI_IN_PLACE,&ok,1,MPI_INT,MPI_MIN,MPI_COMM_WORLD);
+    if(!ok){
+        if(rank==0) printf("error opening file. was size a 4-digit power of 2 or multiple of 1000 between 16 and 5000? ");
+        if(NULL!=fp) fclose(fp);
+        MPI_Finalize();
+        return 2;
+    }
+    A=malloc((size_t)mloc*nloc*sizeof(double)+1);
+    double* row=malloc(size*sizeof(double));
+    for (int li = 0; li < mloc; li++)
+    {
+        fseek(fp,(long)l2g(li,myrow,Pr)*size*sizeof(double),SEEK_SET);
+        fread(row,sizeof(double),size,fp);
+        for (int lc = 0; lc < nloc; lc++) AT(li,lc)=row[l2g(lc,mycol,Pc)];
+    }
+    free(row);
+    fclose(fp);
+
+    double logd=0;
+    int sign=1, singular=0, swaps=0;
+    int* piv=malloc(nb*sizeof(int));
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start=MPI_Wtime();
+
+    for (int k0 = 0; k0 < size; k0+=nb)
+    {
+        int kb=size-k0<nb?size-k0:nb;
+        Factor_panel(k0,kb,piv,&logd,&sign,&singular);
+        for (int j = 0; j < kb; j++) if(piv[j]!=k0+j) swaps++;
+    }
+
+    double finish=MPI_Wtime();
+
+    // combine the per rank pieces of the determinant on rank 0
+    double total_logd;
+    int total_sign, total_singular;
+    // happens after finish, so it is timed on its own instead of in comm_time
+    double reduce_start=MPI_Wtime();
+    MPI_Reduce(&logd,&total_logd,1,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+    MPI_Reduce(&sign,&total_sign,1,MPI_INT,MPI_PROD,0,MPI_COMM_WORLD);
+    MPI_Reduce(&singular,&total_singular,1,MPI_INT,MPI_MAX,0,MPI_COMM_WORLD);
+    double times[3]={finish-start-comm_time,comm_time,MPI_Wtime()-reduce_start};
+    double* all_times=rank==0?malloc(3*procs*sizeof(double)):NULL;
+    MPI_Gather(times,3,MPI_DOUBLE,all_times,3,MPI_DOUBLE,0,MPI_COMM_WORLD);
+
+    if(rank==0){
+        if(swaps%2) total_sign=-total_sign;
+        double d=total_singular?0:total_sign*pow(10,total_logd);
+        printf("Size:%i\nDetermenant: %lf\nSign: %i\nLog(det): %lf\nTime: %f\nProcesses:%i (%ix%i grid)\nBlock:%i \n",
+            size,d,total_singular?0:total_sign,total_singular?-INFINITY:total_logd,finish-start,procs,Pr,Pc,nb);
+        printf("rank\tcompute\tcomm\treduce\n");
+        for (int r = 0; r < procs; r++) printf("%i\t%f\t%f\t%f\n",r,all_times[3*r],all_times[3*r+1],all_times[3*r+2]);
+        printf("\n");
+        free(all_times);
+    }
+
+    free(piv);
+    free(A);
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    MPI_Finalize();
+    return 0;
+}
+
+/* swaps global rows g1 and g2 over local columns [lc_start,lc_end),
+   between the two process rows that own them if they differ */
+void swap_rows(int g1, int g2, int lc_start, int lc_end, double* buf){
+    int o1=owner(g1,Pr), o2=owner(g2,Pr);
+    int width=lc_end-lc_start;
+    if(width<=0||(myrow!=o1&&myrow!=o2)) return;
+    if(o1==o2){
+        double* r1=&AT(g2l(g1,Pr),lc_start);
+        double* r2=&AT(g2l(g2,Pr),lc_start);
+        for (int c = 0; c < width; c++) { double t=r1[c]; r1[c]=r2[c]; r2[c]=t; }
+        return;
+    }
+    int mine=myrow==o1?g1:g2;
+    int other=myrow==o1?o2:o1;
+    double* r=&AT(g2l(mine,Pr),lc_start);
+    COMM(MPI_Sendrecv(r,width,MPI_DOUBLE,other,0,buf,width,MPI_DOUBLE,other,0,col_comm,MPI_STATUS_IGNORE));
+    memcpy(r,buf,width*sizeof(double));
+}
+
+/* factors columns k0..k0+kb-1 and applies them to the trailing matrix.
+   piv gets the global row swapped into each panel row */
+void Factor_panel(int k0, int kb, int* piv, double* logd, int* sign, int* singular){
+    int pc=owner(k0,Pc), pr=owner(k0,Pr);
+    int lc0=g2l(k0,Pc);
+    int lr0=local_count(k0,myrow,Pr);
+    int lrt=local_count(k0+kb,myrow,Pr);
+    int ltc=local_count(k0+kb,mycol,Pc);
+    int ntrail=nloc-ltc;
+    double* buf=malloc((nloc>kb?nloc:kb)*sizeof(double)+1);
+    double* urow=malloc(kb*sizeof(double));
+
+    // panel factorization, only the process column that owns the panel
+    if(mycol==pc){
+        for (int j = k0; j < k0+kb; j++)
+        {
+            int lj=lc0+j-k0;
+            struct { double v; int g; } in={-1,size}, out;
+            for (int li = local_count(j,myrow,Pr); li < mloc; li++)
+            {
+                double v=fabs(AT(li,lj));
+                if(v>in.v){ in.v=v; in.g=l2g(li,myrow,Pr); }
+            }
+            COMM(MPI_Allreduce(&in,&out,1,MPI_DOUBLE_INT,MPI_MAXLOC,col_comm));
+            piv[j-k0]=out.g;
+            if(out.v==0) *singular=1;
+            if(out.g!=j) swap_rows(j,out.g,lc0,lc0+kb,buf);
+
+            int oj=owner(j,Pr);
+            if(myrow==oj) memcpy(urow,&AT(g2l(j,Pr),lc0),kb*sizeof(double));
+            COMM(MPI_Bcast(urow,kb,MPI_DOUBLE,oj,col_comm));
+            double ujj=urow[j-k0];
+            if(myrow==oj&&ujj!=0){
+                *logd+=log10(fabs(ujj));
+                if(ujj<0) *sign=-*sign;
+            }
+            for (int li = local_count(j+1,myrow,Pr); li < mloc; li++)
+            {
+                double l=ujj!=0?AT(li,lj)/ujj:0;
+                AT(li,lj)=l;
+                for (int c = j-k0+1; c < kb; c++) AT(li,lc0+c)-=l*urow[c];
+            }
+        }
+    }
+    COMM(MPI_Bcast(piv,kb,MPI_INT,pc,row_comm));
+
+    // the rest of the columns take the same row swaps
+    for (int j = 0; j < kb; j++)
+        if(piv[j]!=k0+j) swap_rows(k0+j,piv[j],ltc,nloc,buf);
+
+    // L panel goes along the process rows
+    int lrows=mloc-lr0;
+    double* L=malloc((size_t)lrows*kb*sizeof(double)+1);
+    if(mycol==pc)
+        for (int li = lr0; li < mloc; li++) memcpy(&L[(size_t)(li-lr0)*kb],&AT(li,lc0),kb*sizeof(double));
+    COMM(MPI_Bcast(L,lrows*kb,MPI_DOUBLE,pc,row_comm));
+
+    // U block row = L11^-1 A12 on the owning process row, then down the columns
+    double* U=malloc((size_t)kb*ntrail*sizeof(double)+1);
+    if(myrow==pr){
+        for (int r = 1; r < kb; r++)
+        for (int s = 0; s < r; s++)
+        {
+            double l=L[r*kb+s];
+            double* target=&AT(lr0+r,ltc);
+            double* source=&AT(lr0+s,ltc);
+            for (int c = 0; c < ntrail; c++) target[c]-=l*source[c];
+        }
+        for (int r = 0; r < kb; r++) memcpy(&U[(size_t)r*ntrail],&AT(lr0+r,ltc),ntrail*sizeof(double));
+    }
+    COMM(MPI_Bcast(U,kb*ntrail,MPI_DOUBLE,pr,col_comm));
+
+    // trailing update A22 -= L21 U12
+    for (int li = lrt; li < mloc; li++)
+    {
+        double* target=&AT(li,ltc);
+        double* lrow=&L[(size_t)(li-lr0)*kb];
+        for (int s = 0; s < kb; s++)
+        {
+            double l=lrow[s];
+            double* u=&U[(size_t)s*ntrail];
+            for (int c = 0; c < ntrail; c++) target[c]-=l*u[c];
+        }
+    }
+
+    free(U);
+    free(L);
+    free(urow);
+    free(buf);
+}
@@ -0,0 +1,21 @@
+#!/bin/bash
+
+# Runs GaussianMPI on this machine over shared memory for each process count.
+# usage: ./GaussianMPI.sh <size> [block]
+
+output_file="mpi_output.txt"
+size=${1:-1024}
+block=${2:-64}
+
+# Clear the output file before starting
+> "$output_file"
+
+for procs in 1 2 4 6 8; do
+    command="mpirun --oversubscribe --mca btl self,vader -np $procs ./GaussianMPI $size $block"
+
+    echo "Executing: $command" >> "$output_file"
+    $command >> "$output_file" 2>&1
+    echo "-------------------------------" >> "$output_file"
+done
+
+echo "All commands executed and output saved to $output_file"
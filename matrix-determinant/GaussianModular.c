@@ -0,0 +1,347 @@
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <stdint.h>
+ #include <math.h>
+ #include <pthread.h>
+ #include "../common/timer.h"
+
+/* Exact determinant of an integer matrix.
+   The determinant is found modulo enough 62 bit primes to cover twice the
+   Hadamard bound, each thread taking one prime at a time and doing the
+   elimination in Montgomery form. The residues are put back together with
+   Garner's form of the Chinese Remainder Theorem, which runs in parallel
+   over the primes, and the mixed radix digits are turned into a big integer.
+   Compile: gcc -O2 -Wall -o GaussianModular GaussianModular.c -lm -lpthread */
+
+typedef unsigned __int128 u128;
+typedef struct {
+    uint64_t p;      // the prime
+    uint64_t pinv;   // -p^-1 mod 2^64
+    uint64_t r2;     // 2^128 mod p
+} mont_t;
+
+int size;
+int threads;
+int64_t ** m;
+int nprimes;
+uint64_t * primes;
+uint64_t * residues;
+int next_prime=0;
+pthread_mutex_t next_lock=PTHREAD_MUTEX_INITIALIZER;
+pthread_barrier_t barrier;
+
+void* Prime_work(void* rank);
+void* Garner_work(void* rank);
+uint64_t Det_mod(mont_t* M, uint64_t* a);
+
+mont_t Mont_init(uint64_t p){
+    mont_t M;
+    M.p=p;
+    uint64_t inv=p;   // Newton iteration, p*p = 1 mod 8 to start
+    for (int i = 0; i < 5; i++) inv*=2-p*inv;
+    M.pinv=-inv;
+    uint64_t r=(uint64_t)(((u128)1<<64)%p);
+    M.r2=(uint64_t)((u128)r*r%p);
+    return M;
+}
+static inline uint64_t Mont_mul(const mont_t* M, uint64_t a, uint64_t b){
+    u128 t=(u128)a*b;
+    uint64_t q=(uint64_t)t*M->pinv;
+    uint64_t u=(uint64_t)((t+(u128)q*M->p)>>64);
+    return u>=M->p?u-M->p:u;
+}
+static inline uint64_t Mod_sub(uint64_t a, uint64_t b, uint64_t p){
+    return a>=b?a-b:a+p-b;
+}
+uint64_t Mont_pow(const mont_t* M, uint64_t a, uint64_t e){
+    uint64_t r=Mont_mul(M,1,M->r2);
+    while(e){
+        if(e&1) r=Mont_mul(M,r,a);
+        a=Mont_mul(M,a,a);
+        e>>=1;
+    }
+    return r;
+}
+
+uint64_t Pow_mod(uint64_t a, uint64_t e, uint64_t p){
+    uint64_t r=1;
+    a%=p;
+    while(e){
+        if(e&1) r=(uint64_t)((u128)r*a%p);
+        a=(uint64_t)((u128)a*a%p);
+        e>>=1;
+    }
+    return r;
+}
+/* deterministic Miller-Rabin for 64 bit n */
+int Is_prime(uint64_t n){
+    static const uint64_t bases[]={2,3,5,7,11,13,17,19,23,29,31,37};
+    uint64_t d=n-1;
+    int s=0;
+    while(!(d&1)){ d>>=1; s++; }
+    for (int i = 0; i < 12; i++)
+    {
+        uint64_t x=Pow_mod(bases[i],d,n);
+        if(x==1||x==n-1) continue;
+        int composite=1;
+        for (int r = 1; r < s && composite; r++)
+        {
+            x=(uint64_t)((u128)x*x%n);
+            if(x==n-1) composite=0;
+        }
+        if(composite) return 0;
+    }
+    return 1;
+}
+/* inverse of a mod p by extended Euclid */
+uint64_t Inv_mod(uint64_t a, uint64_t p){
+    __int128 t=0, newt=1, r=p, newr=a%p;
+    while(newr){
+        __int128 q=r/newr, tmp;
+        tmp=t-q*newt; t=newt; newt=tmp;
+        tmp=r-q*newr; r=newr; newr=tmp;
+    }
+    if(t<0) t+=p;
+    return (uint64_t)t;
+}
+
+ int main(int argc, char const *argv[])
+{
+
+    if(argc!=3){
+        printf("usage:%s <size> <threads>\n",argv[0]);
+        return 1;
+    }
+    size=strtol(argv[1],NULL,10);
+    threads=strtol(argv[2],NULL,10);
+    if(threads<1){
+        printf("threads must be at least 1\n");
+        return 1;
+    }
+    const char* sizestr=argv[1];
+    char fname[21];
+    sprintf(fname,"input/m%sx%s.bin",sizestr,sizestr);
+    FILE * fp;
+    m=malloc(size*sizeof(int64_t*));
+    fp = fopen(fname, "r");
+    if(NULL==fp){
+        printf("error opening file. was size a 4-digit power of 2 or multiple of 1000 between 16 and 5000? ");
+        return 2;
+    }
+
+    // entries have to be whole numbers that fit in a double exactly.
+    // the Hadamard bound is the sum of the log row lengths
+    double* row=malloc(size*sizeof(double));
+    double bound_bits=0;
+    int zero_row=0;
+    for (int i = 0; i < size; i++)
+    {
+        m[i]=malloc(size*sizeof(int64_t));
+        fread(row,sizeof(double),size,fp);
+        double norm=0;
+        for (int j = 0; j < size; j++)
+        {
+            if(row[j]!=floor(row[j])||fabs(row[j])>9007199254740992.0){
+                printf("entry %i,%i = %lf is not an integer, exact mode needs integer input\n",i,j,row[j]);
+                return 3;
+            }
+            m[i][j]=(int64_t)row[j];
+            norm+=row[j]*row[j];
+        }
+        if(norm==0) zero_row=1;
+        else bound_bits+=0.5*log2(norm);
+    }
+    free(row);
+    fclose(fp);
+
+    double start, finish;
+    GET_TIME(start);
+
+    // every prime is above 2^61, and the product has to pass 2*bound for the sign
+    nprimes=zero_row?0:(int)ceil(bound_bits+2)/61+1;
+    primes=malloc((nprimes+1)*sizeof(uint64_t));
+    residues=malloc((nprimes+1)*sizeof(uint64_t));
+    uint64_t candidate=((uint64_t)1<<62)-1;
+    for (int i = 0; i < nprimes; candidate-=2)
+        if(Is_prime(candidate)) primes[i++]=candidate;
+    // each worker holds a size x size scratch matrix, so no more than one per prime
+    if(threads>nprimes) threads=nprimes>0?nprimes:1;
+
+    pthread_t* thread_handles = malloc (threads*sizeof(pthread_t));
+    for (long thread = 0; thread < threads; thread++)
+       pthread_create(&thread_handles[thread], NULL,
+           Prime_work, (void*) thread);
+    for (int thread = 0; thread < threads; thread++) {
+       pthread_join(thread_handles[thread], NULL);
+    }
+    GET_TIME(finish);
+    double modular_time=finish-start;
+
+    // Garner turns the residues into mixed radix digits in place
+    pthread_barrier_init(&barrier,NULL,threads);
+    for (long thread = 0; thread < threads; thread++)
+       pthread_create(&thread_handles[thread], NULL,
+           Garner_work, (void*) thread);
+    for (int thread = 0; thread < threads; thread++) {
+       pthread_join(thread_handles[thread], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    // x = v0 + p0(v1 + p1(v2 + ...)) and the product of the primes, as
+    // little endian 64 bit limbs
+    uint64_t* x=calloc(nprimes+1,sizeof(uint64_t));
+    uint64_t* prod=calloc(nprimes+1,sizeof(uint64_t));
+    int xlen=0, plen=1;
+    prod[0]=1;
+    for (int i = nprimes-1; i >= 0; i--)
+    {
+        u128 carry=residues[i];
+        for (int l = 0; l < xlen; l++)
+        {
+            carry+=(u128)x[l]*primes[i];
+            x[l]=(uint64_t)carry;
+            carry>>=64;
+        }
+        if(carry) x[xlen++]=(uint64_t)carry;
+    }
+    for (int i = 0; i < nprimes; i++)
+    {
+        u128 carry=0;
+        for (int l = 0; l < plen; l++)
+        {
+            carry+=(u128)prod[l]*primes[i];
+            prod[l]=(uint64_t)carry;
+            carry>>=64;
+        }
+        if(carry) prod[plen++]=(uint64_t)carry;
+    }
+    // anything past half the product is negative: x-prod
+    int negative=0;
+    for (int l = plen-1; l >= 0; l--)
+    {
+        uint64_t xl=l<xlen?x[l]:0;
+        uint64_t half=(prod[l]>>1)|(l+1<plen?prod[l+1]<<63:0);
+        if(xl!=half){ negative=xl>half; break; }
+    }
+    if(negative){
+        uint64_t borrow=0;
+        for (int l = 0; l < plen; l++)
+        {
+            uint64_t xl=l<xlen?x[l]:0;
+            u128 diff=(u128)prod[l]-xl-borrow;
+            x[l]=(uint64_t)diff;
+            borrow=(diff>>64)?1:0;
+        }
+        xlen=plen;
+    }
+    while(xlen>0&&x[xlen-1]==0) xlen--;
+    GET_TIME(finish);
+
+    // decimal digits, 18 at a time from the bottom
+    int chunks=0;
+    uint64_t* dec=malloc((xlen*64/59+2)*sizeof(uint64_t));
+    double logd=-INFINITY;
+    if(xlen>0) logd=log10((double)x[xlen-1])+(xlen-1)*64*log10(2.0);
+    if(xlen>1) logd=log10((double)x[xlen-1]+x[xlen-2]/18446744073709551616.0)+(xlen-1)*64*log10(2.0);
+    while(xlen>0){
+        u128 rem=0;
+        for (int l = xlen-1; l >= 0; l--)
+        {
+            u128 cur=(rem<<64)|x[l];
+            x[l]=(uint64_t)(cur/1000000000000000000ULL);
+            rem=cur%1000000000000000000ULL;
+        }
+        dec[chunks++]=(uint64_t)rem;
+        while(xlen>0&&x[xlen-1]==0) xlen--;
+    }
+    printf("Size:%i\nDetermenant: %s",size,negative?"-":"");
+    if(chunks==0) printf("0");
+    else printf("%llu",(unsigned long long)dec[chunks-1]);
+    for (int c = chunks-2; c >= 0; c--) printf("%018llu",(unsigned long long)dec[c]);
+    printf("\nLog(det): %lf\nPrimes:%i\nTime: %f\nModular time: %f\nThreads:%i \n\n",logd,nprimes,finish-start,modular_time,threads);
+
+    // free and return
+    for (int i = 0; i < size; i++)
+    {
+        free(m[i]);
+    }
+    free(m);
+    free(dec);
+    free(x);
+    free(prod);
+    free(primes);
+    free(residues);
+    free(thread_handles);
+    return 0;
+}
+
+/* takes primes off the shared counter until they run out */
+void* Prime_work(void* in){
+    uint64_t* a=malloc((size_t)size*size*sizeof(uint64_t));
+    while(1){
+        pthread_mutex_lock(&next_lock);
+        int i=next_prime++;
+        pthread_mutex_unlock(&next_lock);
+        if(i>=nprimes) break;
+        mont_t M=Mont_init(primes[i]);
+        residues[i]=Det_mod(&M,a);
+    }
+    free(a);
+    return NULL;
+}
+
+/* determinant of m mod M->p, using a as scratch */
+uint64_t Det_mod(mont_t* M, uint64_t* a){
+    uint64_t p=M->p;
+    for (int r = 0; r < size; r++)
+    for (int c = 0; c < size; c++)
+    {
+        int64_t v=m[r][c]%(int64_t)p;
+        a[(size_t)r*size+c]=Mont_mul(M,v<0?(uint64_t)(v+(int64_t)p):(uint64_t)v,M->r2);
+    }
+    uint64_t det=Mont_mul(M,1,M->r2);
+    for (int pivot = 0; pivot < size; pivot++)
+    {
+        int r=pivot;
+        while(r<size&&a[(size_t)r*size+pivot]==0) r++;
+        if(r==size) return 0;
+        uint64_t* prow=&a[(size_t)pivot*size];
+        if(r!=pivot){
+            uint64_t* other=&a[(size_t)r*size];
+            for (int c = pivot; c < size; c++) { uint64_t t=prow[c]; prow[c]=other[c]; other[c]=t; }
+            det=p-det;
+        }
+        det=Mont_mul(M,det,prow[pivot]);
+        uint64_t inv=Mont_pow(M,prow[pivot],p-2);
+        for (r = pivot+1; r < size; r++)
+        {
+            uint64_t* target=&a[(size_t)r*size];
+            if(target[pivot]==0) continue;
+            uint64_t mult=Mont_mul(M,target[pivot],inv);
+            for (int c = pivot+1; c < size; c++)
+                target[c]=Mod_sub(target[c],Mont_mul(M,mult,prow[c]),p);
+        }
+    }
+    return Mont_mul(M,det,1);
+}
+
+/* after step i, residues[i] is the i-th mixed radix digit and every later
+   residue j holds (x - v0 - v1 p0 - ... - vi p0..p(i-1)) / (p0..pi) mod pj.
+   the j's are split between the threads with a barrier per digit */
+void* Garner_work(void* in){
+    long rank=(long)in;
+    for (int i = 0; i < nprimes; i++)
+    {
+        uint64_t v=residues[i];
+        for (int j = i+1+rank; j < nprimes; j+=threads)
+        {
+            uint64_t pj=primes[j];
+            uint64_t diff=Mod_sub(residues[j],v%pj,pj);
+            residues[j]=(uint64_t)((u128)diff*Inv_mod(primes[i]%pj,pj)%pj);
+        }
+        pthread_barrier_wait(&barrier);
+    }
+    return NULL;
+}
@@ -4,24 +4,38 @@
  #include <string.h>
  #include <math.h>
  #include <pthread.h>
- #include "timer.h"
+ #include <unistd.h>
+ #include "../common/profile.h"
+ #define PROFILE_FILE "tuning.txt"
+ #define MAX_PROFILE 64
+ #define TUNE_REPS 3
  double d;
  double logd;
  int size;
  double ** m;
- pthread_mutex_t * done;
+ pthread_barrier_t barrier;
+ int * cand;
+ int * ncand;
  void* Thread_work(void* rank);
  void apply(int pivot, int target);
+ int Select(int* rows, int n, int k0, int kb, int* out);
+ void Tournament(int k0, int kb);
+ double Eliminate(void);
+ void Tune(int max_threads);
+ int Load_profile(int size, int* best_threads, int* best_block);
+ void Save_profile(int size, int best_threads, int best_block, double best_time);
 int threads;
+int block=32;
  int main(int argc, char const *argv[])
-{ 
-    
-    if(argc!=3){
-        printf("usage:%s <size> <threads>\n",argv[0]);
+{
+
+    if(argc<3||argc>4){
+        printf("usage:%s <size> <threads> [block]\n",argv[0]);
+        printf("       %s <size> auto\n",argv[0]);
+        printf("       %s <size> tune [max threads]\n",argv[0]);
         return 1;
     }
     size=strtol(argv[1],NULL,10);
-    threads=strtol(argv[2],NULL,10);
     const char* sizestr=argv[1];
     char fname[21];
     sprintf(fname,"input/m%sx%s.bin",sizestr,sizestr);
@@ -39,73 +53,328 @@ int threads;
         fread(m[i],sizeof(double),size,fp);
     }
     fclose(fp);
-    d=1; 
+
+    if(strcmp(argv[2],"tune")==0){
+        int max_threads=sysconf(_SC_NPROCESSORS_ONLN);
+        if(argc==4) max_threads=strtol(argv[3],NULL,10);
+        if(max_threads<1){
+            printf("max threads must be at least 1\n");
+            return 1;
+        }
+        PROF_INIT(max_threads);
+        Tune(max_threads);
+    } else {
+        if(strcmp(argv[2],"auto")==0){
+            if(Load_profile(size,&threads,&block)!=0){
+                printf("no tuning profile in %s, run with 'tune' first. using 1 thread\n",PROFILE_FILE);
+                threads=1;
+                block=1;
+            }
+        } else {
+            threads=strtol(argv[2],NULL,10);
+            if(argc==4) block=strtol(argv[3],NULL,10);
+        }
+        if(threads<1||block<1){
+            printf("threads and block must be at least 1\n");
+            return 1;
+        }
+        PROF_INIT(threads);
+        double elapsed=Eliminate();
+        printf("Size:%i\nDetermenant: %lf\nLog(det): %lf\nTime: %f\nThreads:%i \nBlock:%i \n\n",size, d,logd,elapsed,threads,block);
+    }
+
+    // free and return
+    for (int i = 0; i < size; i++)
+    {
+        //for (int j = 0; j < size; j++) printf("%lf ",m[i][j]);printf("\n");
+        free(m[i]);
+    }
+    free(m);
+    PROF_REPORT();
+    return 0;
+}
+
+/* runs the elimination on m with the current threads and block, returns the time.
+   one thread is done serially with partial pivoting, so small sizes don't pay
+   for the barriers */
+double Eliminate(void){
+    d=1;
     logd=0;
     double start, finish;
     GET_TIME(start);
 
-    done=malloc(sizeof(pthread_mutex_t)*size);
-    for (int i = 0; i < size; i++)
-    {
-        pthread_mutex_init(&done[i],NULL);
-        pthread_mutex_lock(&done[i]);
-        
+    if(threads==1){
+        for (int pivot = 0; pivot < size; pivot++) {
+            PROF_START(row_start);
+            int best=pivot;
+            for (int r = pivot+1; r < size; r++)
+                if(fabs(m[r][pivot])>fabs(m[best][pivot])) best=r;
+            if(best!=pivot){
+                double* t=m[pivot]; m[pivot]=m[best]; m[best]=t;
+                d=-d;
+            }
+            logd+=log10(fabs(m[pivot][pivot]));
+            d*=m[pivot][pivot];
+            for (int r = pivot+1; r < size; r++) {
+                apply(pivot,r);
+            }
+            PROF_STOP(0,"row",row_start);
+            PROF_COUNT(0,"rows updated",size-pivot-1);
+        }
+        GET_TIME(finish);
+        return finish-start;
     }
-    pthread_mutex_unlock(&done[0]);
-    
+
+    cand=malloc(threads*block*sizeof(int));
+    ncand=malloc(threads*sizeof(int));
+    pthread_barrier_init(&barrier,NULL,threads);
+
     pthread_t* thread_handles = malloc (threads*sizeof(pthread_t));
-     for (int thread = 0; thread < threads; thread++)
+     for (long thread = 0; thread < threads; thread++)
        pthread_create(&thread_handles[thread], NULL,
            Thread_work, (void*) thread);
- 
+
     for (int thread = 0; thread < threads; thread++) {
        pthread_join(thread_handles[thread], NULL);
     }
-    
-    
-    
-    GET_TIME(finish);
 
 
 
+    GET_TIME(finish);
 
-    // free and return
-    for (int i = 0; i < size; i++)
+    pthread_barrier_destroy(&barrier);
+    free(cand);
+    free(ncand);
+    free(thread_handles);
+    return finish-start;
+}
+
+/* Works through the matrix a panel of block columns at a time. Rows are
+   handed out in blocks of block rows, round robin between threads, and a
+   thread only ever updates its own rows.
+   For each panel every thread picks block candidate pivot rows out of its own
+   rows, rank 0 plays them off against each other in a tournament and swaps
+   the winners to the top (tournament pivoting, as in CALU), and then every
+   thread eliminates the panel from its rows. That is one pivot decision per
+   panel instead of a column search and a wait on every column. */
+void* Thread_work(void* in){
+    long rank=(long)in;
+    int* rows=malloc(size*sizeof(int));
+    for (int k0 = 0; k0 < size; k0+=block)
     {
-        //for (int j = 0; j < size; j++) printf("%lf ",m[i][j]);printf("\n");
-        free(m[i]);
+        int kb=size-k0<block?size-k0:block;
+        int n=0;
+        for (int first = rank*block; first < size; first+=threads*block)
+        for (int r = first; r < first+block && r < size; r++)
+            if(r>=k0) rows[n++]=r;
+        ncand[rank]=Select(rows,n,k0,kb,&cand[rank*block]);
+
+        PROF_START(wait_start);
+        pthread_barrier_wait(&barrier);
+        PROF_WAIT(rank,"wait barrier",wait_start);
+        if(rank==0){
+            PROF_START(panel_start);
+            Tournament(k0,kb);
+            PROF_STOP(0,"tournament",panel_start);
+        }
+        PROF_START(wait2_start);
+        pthread_barrier_wait(&barrier);
+        PROF_WAIT(rank,"wait barrier",wait2_start);
+
+        PROF_START(row_start);
+        for (int i = 0; i < n; i++)
+        {
+            if(rows[i]<k0+kb) continue;
+            for (int pivot = k0; pivot < k0+kb; pivot++) apply(pivot,rows[i]);
+            PROF_COUNT(rank,"rows updated",kb);
+        }
+        PROF_STOP(rank,"panel update",row_start);
     }
-    free(m);
-    free(done);
-    printf("Size:%i\nDetermenant: %lf\nLog(det): %lf\nTime: %f\nThreads:%i \n\n",size, d,logd,finish-start,threads);
-    return 0;
+    free(rows);
+    return NULL;
 }
 
-void* Thread_work(void* in){
-    int rank=in;
-    //printf("rank:%i\n",*rank);
-    for (int target = rank; target < size; target+=threads)
+/* partial pivoting on a copy of the panel columns of the given rows, puts the
+   rows it would pivot on in out and returns how many that is */
+int Select(int* rows, int n, int k0, int kb, int* out){
+    int count=n<kb?n:kb;
+    double* a=malloc((size_t)n*kb*sizeof(double));
+    int* idx=malloc(n*sizeof(int));
+    for (int i = 0; i < n; i++)
+    {
+        memcpy(&a[(size_t)i*kb],&m[rows[i]][k0],kb*sizeof(double));
+        idx[i]=rows[i];
+    }
+    for (int j = 0; j < count; j++)
     {
-        for (int pivot = 0; pivot < target; pivot++)
+        int best=j;
+        for (int i = j+1; i < n; i++)
+            if(fabs(a[(size_t)i*kb+j])>fabs(a[(size_t)best*kb+j])) best=i;
+        if(best!=j){
+            for (int c = 0; c < kb; c++)
+            {
+                double t=a[(size_t)j*kb+c]; a[(size_t)j*kb+c]=a[(size_t)best*kb+c]; a[(size_t)best*kb+c]=t;
+            }
+            int t=idx[j]; idx[j]=idx[best]; idx[best]=t;
+        }
+        out[j]=idx[j];
+        double p=a[(size_t)j*kb+j];
+        if(p==0) continue;
+        for (int i = j+1; i < n; i++)
         {
-            //printf("waiting for finish of row %i in thread %i\n",pivot,rank);
-            pthread_mutex_lock(&done[pivot]);
-            pthread_mutex_unlock(&done[pivot]);
-            apply(pivot,target);
-            //printf("in thread %i, row %i to row %i\n", *rank,pivot,target);
+            double mult=a[(size_t)i*kb+j]/p;
+            for (int c = j+1; c < kb; c++) a[(size_t)i*kb+c]-=a[(size_t)j*kb+c]*mult;
         }
-        pthread_mutex_unlock(&done[target]);
-        //printf("done doing %i in thread %i\n",target,rank);
-         logd+=log10(fabs(m[target][target]));
-        d*=m[target][target];
-        
     }
+    free(idx);
+    free(a);
+    return count;
+}
 
+/* reduces the threads' candidates pairwise in a tree down to kb winners,
+   swaps them into rows k0.. and eliminates the panel among them.
+   only rank 0 runs this, between the two barriers */
+void Tournament(int k0, int kb){
+    int* merged=malloc(2*block*sizeof(int));
+    for (int step = 1; step < threads; step*=2)
+    for (int t = 0; t+step < threads; t+=2*step)
+    {
+        int n=0;
+        for (int i = 0; i < ncand[t]; i++) merged[n++]=cand[t*block+i];
+        for (int i = 0; i < ncand[t+step]; i++) merged[n++]=cand[(t+step)*block+i];
+        ncand[t]=Select(merged,n,k0,kb,&cand[t*block]);
+    }
+    for (int j = 0; j < kb; j++)
+    {
+        int w=cand[j];
+        if(w!=k0+j){
+            double* t=m[k0+j]; m[k0+j]=m[w]; m[w]=t;
+            d=-d;
+            // a later winner may have been sitting in row k0+j
+            for (int l = j+1; l < kb; l++) if(cand[l]==k0+j) cand[l]=w;
+        }
+    }
+    for (int pivot = k0; pivot < k0+kb; pivot++)
+    {
+        logd+=log10(fabs(m[pivot][pivot]));
+        d*=m[pivot][pivot];
+        for (int r = pivot+1; r < k0+kb; r++) apply(pivot,r);
+    }
+    free(merged);
 }
 
 void apply(int pivot, int target){
+    // a zero pivot means the determinant is already 0
+    if(m[pivot][pivot]==0) return;
     double mult=m[target][pivot]/m[pivot][pivot];
             for(int c=pivot;c<size;c++){
                 m[target][c]-=m[pivot][c]*mult;
             }
-}
\ No newline at end of file
+}
+
+int compare_double(const void* a, const void* b){
+    double x=*(const double*)a, y=*(const double*)b;
+    return (x>y)-(x<y);
+}
+
+/* times every thread count up to max_threads against every block size,
+   keeps the median of TUNE_REPS runs and saves the fastest to the profile */
+void Tune(int max_threads){
+    int blocks[]={1,4,8,16,32,64};
+    int nblocks=sizeof(blocks)/sizeof(blocks[0]);
+    double ** orig=malloc(size*sizeof(double*));
+    for (int i = 0; i < size; i++)
+    {
+        orig[i]=malloc(size*sizeof(double));
+        memcpy(orig[i],m[i],size*sizeof(double));
+    }
+    int best_threads=1, best_block=1;
+    double best_time=INFINITY;
+    printf("threads\tblock\tmedian\n");
+    for (threads = 1; threads <= max_threads; threads++)
+    for (int b = 0; b < nblocks; b++)
+    {
+        block=blocks[b];
+        // block makes no difference to the serial run
+        if(threads==1&&block>1) continue;
+        if(threads>1&&block*threads>size) continue;
+        double times[TUNE_REPS];
+        for (int rep = 0; rep < TUNE_REPS; rep++)
+        {
+            for (int i = 0; i < size; i++) memcpy(m[i],orig[i],size*sizeof(double));
+            times[rep]=Eliminate();
+        }
+        qsort(times,TUNE_REPS,sizeof(double),compare_double);
+        double median=times[TUNE_REPS/2];
+        printf("%i\t%i\t%f\n",threads,block,median);
+        if(median<best_time){
+            best_time=median;
+            best_threads=threads;
+            best_block=block;
+        }
+    }
+    for (int i = 0; i < size; i++) free(orig[i]);
+    free(orig);
+    // nothing ran, keep whatever the profile already has for this size
+    if(best_time==INFINITY){
+        printf("no configuration was timed for size %i, %s not changed\n",size,PROFILE_FILE);
+        return;
+    }
+    printf("Size:%i\nBest threads:%i\nBest block:%i\nTime: %f\nsaved to %s\n\n",size,best_threads,best_block,best_time,PROFILE_FILE);
+    Save_profile(size,best_threads,best_block,best_time);
+}
+
+/* profile lines are "size threads block time", sorted by size.
+   a size that wasn't tuned uses the nearest tuned size below it, and anything
+   smaller than the first size where threading won runs serially */
+int Load_profile(int size, int* best_threads, int* best_block){
+    FILE* fp=fopen(PROFILE_FILE,"r");
+    if(NULL==fp) return 1;
+    int s,t,b;
+    double time;
+    int crossover=-1, found=0, found_size=-1;
+    while(fscanf(fp,"%i %i %i %lf",&s,&t,&b,&time)==4){
+        if(t>1&&(crossover<0||s<crossover)) crossover=s;
+        if(s<=size&&s>found_size){
+            found_size=s;
+            *best_threads=t;
+            *best_block=b;
+            found=1;
+        }
+    }
+    fclose(fp);
+    if(crossover<0||size<crossover){
+        *best_threads=1;
+        *best_block=1;
+        return 0;
+    }
+    return found?0:1;
+}
+
+void Save_profile(int size, int best_threads, int best_block, double best_time){
+    int sizes[MAX_PROFILE], t[MAX_PROFILE], b[MAX_PROFILE];
+    double times[MAX_PROFILE];
+    int n=0;
+    FILE* fp=fopen(PROFILE_FILE,"r");
+    if(NULL!=fp){
+        while(n<MAX_PROFILE&&fscanf(fp,"%i %i %i %lf",&sizes[n],&t[n],&b[n],&times[n])==4){
+            if(sizes[n]!=size) n++;
+        }
+        fclose(fp);
+    }
+    if(n==MAX_PROFILE) n--;
+    int i=n++;
+    // insertion keeps the file sorted by size
+    while(i>0&&sizes[i-1]>size){
+        sizes[i]=sizes[i-1]; t[i]=t[i-1]; b[i]=b[i-1]; times[i]=times[i-1];
+        i--;
+    }
+    sizes[i]=size; t[i]=best_threads; b[i]=best_block; times[i]=best_time;
+    fp=fopen(PROFILE_FILE,"w");
+    if(NULL==fp){
+        printf("error writing %s\n",PROFILE_FILE);
+        return;
+    }
+    for (i = 0; i < n; i++) fprintf(fp,"%i %i %i %f\n",sizes[i],t[i],b[i],times[i]);
+    fclose(fp);
+}
@@ -0,0 +1,90 @@
+
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <math.h>
+ #include "../common/timer.h"
+ #include "lu_update.h"
+
+/* Determinants of a matrix that keeps getting k rows or columns replaced.
+   Each update goes through lu_update, alternating rows and columns, and at
+   the end the result is checked against a full factorization.
+   Compile: gcc -O2 -Wall -o GaussianUpdate GaussianUpdate.c lu_update.c -lm */
+
+ int main(int argc, char const *argv[])
+{
+
+    if(argc<4||argc>5){
+        printf("usage:%s <size> <updates> <k> [max rank]\n",argv[0]);
+        return 1;
+    }
+    int size=strtol(argv[1],NULL,10);
+    int updates=strtol(argv[2],NULL,10);
+    int k=strtol(argv[3],NULL,10);
+    int max_rank=argc==5?strtol(argv[4],NULL,10):32;
+    if(k<1||k>size||max_rank<1){
+        printf("k must be between 1 and size, max rank at least 1\n");
+        return 1;
+    }
+    const char* sizestr=argv[1];
+    char fname[21];
+    sprintf(fname,"input/m%sx%s.bin",sizestr,sizestr);
+    FILE * fp;
+    double * m=malloc((size_t)size*size*sizeof(double));
+    fp = fopen(fname, "r");
+    if(NULL==fp){
+        printf("error opening file. was size a 4-digit power of 2 or multiple of 1000 between 16 and 5000? ");
+        return 2;
+    }
+    fread(m,sizeof(double),(size_t)size*size,fp);
+    fclose(fp);
+
+    double start, finish;
+    GET_TIME(start);
+    lu_state* s=LU_create(m,size,max_rank);
+    GET_TIME(finish);
+    double factor_time=finish-start;
+    printf("Size:%i\nLog(det): %lf\nSign: %i\nFactor time: %f\n",size,s->logd,s->sign,factor_time);
+
+    // new rows and columns come from the same range as the input
+    double lo=INFINITY, hi=-INFINITY;
+    for (size_t i = 0; i < (size_t)size*size; i++)
+    {
+        if(m[i]<lo) lo=m[i];
+        if(m[i]>hi) hi=m[i];
+    }
+    unsigned int seed=256;
+    int* index=malloc(k*sizeof(int));
+    double* values=malloc((size_t)k*size*sizeof(double));
+    double update_time=0;
+    for (int u = 0; u < updates; u++)
+    {
+        for (int i = 0; i < k; i++)
+        {
+            index[i]=rand_r(&seed)%size;
+            for (int c = 0; c < size; c++) values[(size_t)i*size+c]=lo+(hi-lo)*rand_r(&seed)/RAND_MAX;
+        }
+        GET_TIME(start);
+        if(u%2==0) LU_replace_rows(s,k,index,values);
+        else LU_replace_cols(s,k,index,values);
+        GET_TIME(finish);
+        update_time+=finish-start;
+    }
+
+    // the same matrix from scratch
+    GET_TIME(start);
+    lu_state* check=LU_create(s->a,size,1);
+    GET_TIME(finish);
+
+    printf("Updates:%i of %i %s\nUpdated Log(det): %lf\nUpdated Sign: %i\nRefactored Log(det): %lf\nRefactored Sign: %i\n",
+        updates,k,k==1?"row/column":"rows/columns",s->logd,s->sign,check->logd,check->sign);
+    printf("Update time: %f\nAverage update time: %f\nRefactor time: %f\nRefactors:%i \n\n",
+        update_time,updates>0?update_time/updates:0,finish-start,s->refactors-1);
+
+    LU_free(check);
+    LU_free(s);
+    free(index);
+    free(values);
+    free(m);
+    return 0;
+}
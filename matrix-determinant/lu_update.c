@@ -0,0 +1,192 @@
+
+ #include <stdlib.h>
+ #include <string.h>
+ #include <math.h>
+ #include "lu_update.h"
+
+/* smallest pivot of the capacitance matrix, relative to the largest, before
+   we stop trusting the update and refactor */
+ #define CAP_TOLERANCE 1e-8
+
+/* LU with partial pivoting of the n x n row major a in place.
+   fills perm if it isn't NULL, returns the ratio of the smallest to the
+   largest pivot (0 if singular) and sets sign and logd */
+static double Factor(double* a, int n, int* perm, int* sign, double* logd){
+    double smallest=INFINITY, largest=0;
+    *sign=1;
+    *logd=0;
+    if(perm!=NULL) for (int i = 0; i < n; i++) perm[i]=i;
+    for (int pivot = 0; pivot < n; pivot++)
+    {
+        int best=pivot;
+        for (int r = pivot+1; r < n; r++)
+            if(fabs(a[(size_t)r*n+pivot])>fabs(a[(size_t)best*n+pivot])) best=r;
+        if(best!=pivot){
+            for (int c = 0; c < n; c++)
+            {
+                double t=a[(size_t)pivot*n+c]; a[(size_t)pivot*n+c]=a[(size_t)best*n+c]; a[(size_t)best*n+c]=t;
+            }
+            if(perm!=NULL){ int t=perm[pivot]; perm[pivot]=perm[best]; perm[best]=t; }
+            *sign=-*sign;
+        }
+        double* prow=&a[(size_t)pivot*n];
+        double p=fabs(prow[pivot]);
+        if(p<smallest) smallest=p;
+        if(p>largest) largest=p;
+        if(p==0){
+            *sign=0;
+            *logd=-INFINITY;
+            return 0;
+        }
+        if(prow[pivot]<0) *sign=-*sign;
+        *logd+=log10(p);
+        for (int r = pivot+1; r < n; r++)
+        {
+            double* target=&a[(size_t)r*n];
+            double mult=target[pivot]/prow[pivot];
+            target[pivot]=mult;
+            for (int c = pivot+1; c < n; c++) target[c]-=prow[c]*mult;
+        }
+    }
+    return largest>0?smallest/largest:0;
+}
+
+/* x = A0^-1 b with the stored factors */
+static void Solve(lu_state* s, const double* b, double* x){
+    int n=s->n;
+    for (int i = 0; i < n; i++)
+    {
+        double sum=b[s->perm[i]];
+        const double* row=&s->lu[(size_t)i*n];
+        for (int j = 0; j < i; j++) sum-=row[j]*x[j];
+        x[i]=sum;
+    }
+    for (int i = n-1; i >= 0; i--)
+    {
+        double sum=x[i];
+        const double* row=&s->lu[(size_t)i*n];
+        for (int j = i+1; j < n; j++) sum-=row[j]*x[j];
+        x[i]=sum/row[i];
+    }
+}
+
+lu_state* LU_create(const double* a, int n, int max_rank){
+    lu_state* s=calloc(1,sizeof(lu_state));
+    s->n=n;
+    s->max_rank=max_rank;
+    s->a=malloc((size_t)n*n*sizeof(double));
+    s->lu=malloc((size_t)n*n*sizeof(double));
+    s->perm=malloc(n*sizeof(int));
+    s->U=malloc((size_t)n*max_rank*sizeof(double));
+    s->V=malloc((size_t)n*max_rank*sizeof(double));
+    s->W=malloc((size_t)n*max_rank*sizeof(double));
+    s->C=malloc((size_t)max_rank*max_rank*sizeof(double));
+    memcpy(s->a,a,(size_t)n*n*sizeof(double));
+    LU_refactor(s);
+    return s;
+}
+
+void LU_free(lu_state* s){
+    free(s->a);
+    free(s->lu);
+    free(s->perm);
+    free(s->U);
+    free(s->V);
+    free(s->W);
+    free(s->C);
+    free(s);
+}
+
+void LU_refactor(lu_state* s){
+    int n=s->n;
+    memcpy(s->lu,s->a,(size_t)n*n*sizeof(double));
+    Factor(s->lu,n,s->perm,&s->base_sign,&s->base_logd);
+    s->sign=s->base_sign;
+    s->logd=s->base_logd;
+    s->rank=0;
+    s->refactors++;
+}
+
+/* adds the k columns from s->U and s->V past the current rank, solves for W,
+   extends C and recomputes the determinant from the lemma */
+static void Update(lu_state* s, int k){
+    int n=s->n, r0=s->rank, r=s->rank+k, mr=s->max_rank;
+    for (int j = r0; j < r; j++) Solve(s,&s->U[(size_t)j*n],&s->W[(size_t)j*n]);
+    // C[i][j] = (i==j) + V_i . W_j, only the new rows and columns change
+    for (int i = 0; i < r; i++)
+    for (int j = (i<r0?r0:0); j < r; j++)
+    {
+        const double* v=&s->V[(size_t)i*n];
+        const double* w=&s->W[(size_t)j*n];
+        double sum=i==j;
+        for (int l = 0; l < n; l++) sum+=v[l]*w[l];
+        s->C[i*mr+j]=sum;
+    }
+    s->rank=r;
+
+    double* c=malloc((size_t)r*r*sizeof(double));
+    for (int i = 0; i < r; i++) memcpy(&c[i*r],&s->C[i*mr],r*sizeof(double));
+    int csign;
+    double clogd;
+    double ratio=Factor(c,r,NULL,&csign,&clogd);
+    free(c);
+    if(ratio<CAP_TOLERANCE){
+        // either the matrix really is (nearly) singular or the update lost
+        // accuracy, a fresh factorization tells which
+        LU_refactor(s);
+        return;
+    }
+    s->sign=s->base_sign*csign;
+    s->logd=s->base_logd+clogd;
+}
+
+void LU_replace_rows(lu_state* s, int k, const int* rows, const double* values){
+    int n=s->n;
+    // past max_rank, or on a singular A0 where W can't be solved for,
+    // just change the matrix and start over
+    if(s->rank+k>s->max_rank||s->base_sign==0){
+        for (int i = 0; i < k; i++) memcpy(&s->a[(size_t)rows[i]*n],&values[(size_t)i*n],n*sizeof(double));
+        LU_refactor(s);
+        return;
+    }
+    // row i of A += (new - old): U column e_i, V column new - old
+    for (int i = 0; i < k; i++)
+    {
+        double* u=&s->U[(size_t)(s->rank+i)*n];
+        double* v=&s->V[(size_t)(s->rank+i)*n];
+        double* row=&s->a[(size_t)rows[i]*n];
+        memset(u,0,n*sizeof(double));
+        u[rows[i]]=1;
+        for (int c = 0; c < n; c++)
+        {
+            v[c]=values[(size_t)i*n+c]-row[c];
+            row[c]=values[(size_t)i*n+c];
+        }
+    }
+    Update(s,k);
+}
+
+void LU_replace_cols(lu_state* s, int k, const int* cols, const double* values){
+    int n=s->n;
+    if(s->rank+k>s->max_rank||s->base_sign==0){
+        for (int i = 0; i < k; i++)
+        for (int r = 0; r < n; r++) s->a[(size_t)r*n+cols[i]]=values[(size_t)i*n+r];
+        LU_refactor(s);
+        return;
+    }
+    // column j of A += (new - old): U column new - old, V column e_j
+    for (int i = 0; i < k; i++)
+    {
+        double* u=&s->U[(size_t)(s->rank+i)*n];
+        double* v=&s->V[(size_t)(s->rank+i)*n];
+        memset(v,0,n*sizeof(double));
+        v[cols[i]]=1;
+        for (int r = 0; r < n; r++)
+        {
+            double* entry=&s->a[(size_t)r*n+cols[i]];
+            u[r]=values[(size_t)i*n+r]-*entry;
+            *entry=values[(size_t)i*n+r];
+        }
+    }
+    Update(s,k);
+}
@@ -0,0 +1,50 @@
+/* File:     lu_update.h
+ *
+ * Purpose:  Keep the LU factors of a matrix around so the determinant of
+ *           a matrix that differs from it by a few replaced rows or
+ *           columns costs O(k n^2) instead of a new O(n^3) elimination.
+ *
+ *           The changes since the last factorization are kept as
+ *           A = A0 + U V^T, with W = A0^-1 U, and by the matrix
+ *           determinant lemma det(A) = det(A0) det(I + V^T W), where the
+ *           capacitance matrix I + V^T W is only rank x rank.  Once the
+ *           rank reaches max_rank, or the capacitance matrix gets badly
+ *           conditioned, the current matrix is factored again from scratch.
+ *
+ * Example:
+ *    lu_state* s = LU_create(a, n, 32);
+ *    LU_replace_rows(s, 2, rows, new_rows);
+ *    printf("%i %lf\n", s->sign, s->logd);
+ *    LU_free(s);
+ */
+#ifndef _LU_UPDATE_H_
+#define _LU_UPDATE_H_
+
+typedef struct {
+   int n;
+   double* a;        // the current matrix, row major
+   double* lu;       // L and U of A0, the matrix at the last refactor
+   int* perm;        // row i of lu is row perm[i] of A0
+   int base_sign;    // sign and log10|det| of A0
+   double base_logd;
+   int rank, max_rank;
+   double* U;        // rank columns of n, column j at U[j*n]
+   double* V;
+   double* W;        // A0^-1 U, same layout
+   double* C;        // I + V^T W, max_rank x max_rank
+   int sign;         // sign and log10|det| of the current matrix, 0 and -inf if singular
+   double logd;
+   int refactors;
+} lu_state;
+
+/* copies a, which is n x n row major, and factors it */
+lu_state* LU_create(const double* a, int n, int max_rank);
+void LU_free(lu_state* s);
+/* factors the current matrix from scratch and drops the updates */
+void LU_refactor(lu_state* s);
+/* replaces rows[0..k) of the matrix with the k rows of n in values */
+void LU_replace_rows(lu_state* s, int k, const int* rows, const double* values);
+/* replaces cols[0..k) of the matrix, values holds each new column contiguously */
+void LU_replace_cols(lu_state* s, int k, const int* cols, const double* values);
+
+#endif
@@ -2,11 +2,12 @@
 
 // Compile: gcc -g -Wall -o atsp_pth atsp_pth.c -lm -lpthread
 // Execute: ./atsp_pth <number of threads> <seed>
+// Profile: add -DPROFILE, and run with PROFILE_TRACE=trace.json for a timeline
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
-#include "timer.h"
+#include "../common/profile.h"
 #include <limits.h>
 #include <string.h>
 
@@ -24,6 +25,7 @@ pthread_rwlock_t rwlock_travel_matrix = PTHREAD_RWLOCK_INITIALIZER;
 pthread_rwlock_t rwlock_best_tour = PTHREAD_RWLOCK_INITIALIZER;
 
 double *non_comm_end_time;
+long *tours_built;
 
 typedef struct
 {
@@ -43,9 +45,11 @@ int main(int argc, char *argv[])
   double start, finish, elapsed;
   pthread_t *thread_handles;
 
-  GET_TIME(start);
-
   Get_args(argc, argv);
+  // before start, so profiler setup doesn't eat into the 60 second budget
+  PROF_INIT(thread_count);
+
+  GET_TIME(start);
 
   non_comm_end_time = malloc(thread_count * sizeof(double));
   if (non_comm_end_time == NULL)
@@ -54,6 +58,13 @@ int main(int argc, char *argv[])
     exit(1); // Handle memory allocation failure
   }
 
+  tours_built = malloc(thread_count * sizeof(long));
+  if (tours_built == NULL)
+  {
+    printf("tours_built failed to allocate\n");
+    exit(1); // Handle memory allocation failure
+  }
+
   thread_handles = (pthread_t *)malloc(thread_count * sizeof(pthread_t));
   if (thread_handles == NULL)
   {
@@ -135,6 +146,12 @@ int main(int argc, char *argv[])
   printf("Best tour value: %d\n", global_best_tour_value);
   printf("Number of threads: %ld\n", thread_count);
   printf("Elapsed time = %e seconds\n", elapsed);
+  // the run always lasts 60 seconds, so compare thread counts by throughput
+  long total_tours = 0;
+  for (int i = 0; i < thread_count; i++)
+    total_tours += tours_built[i];
+  printf("Tours built: %ld\n", total_tours);
+  printf("Tours per second: %f\n", total_tours / elapsed);
   for (int i = 0; i < thread_count; i++)
   {
     printf("Thread %d post-loop time %e\n",
@@ -144,6 +161,8 @@ int main(int argc, char *argv[])
   free(thread_handles);
   free(arguments);
   free(non_comm_end_time);
+  free(tours_built);
+  PROF_REPORT();
   return 0;
 }
 
@@ -153,6 +172,7 @@ void *Find_best_tour(void *arguments)
   long my_rank = (long)args->rank;
   unsigned int my_seed = seed + my_rank;
   double my_working_time;
+  long my_tours = 0;
 
   int *my_best_tour = malloc(ROWS * sizeof(int));
   int my_best_tour_value = INT_MAX;
@@ -162,7 +182,11 @@ void *Find_best_tour(void *arguments)
     int city_start = rand_r(&my_seed) % ROWS;
     int *test_tour = malloc((ROWS + 1) * sizeof(int));
     int tour_value = 0;
+    PROF_START(tour_start);
     Find_tour(test_tour, &tour_value, city_start);
+    PROF_STOP(my_rank, "Find_tour", tour_start);
+    PROF_COUNT(my_rank, "tours built", 1);
+    my_tours++;
 
     if (tour_value < my_best_tour_value)
     {
@@ -177,9 +201,12 @@ void *Find_best_tour(void *arguments)
   } while (my_working_time - args->start_time < 60.0);
 
   non_comm_end_time[my_rank] = my_working_time;
+  tours_built[my_rank] = my_tours;
 
   // grab write lock
+  PROF_START(wait_start);
   pthread_rwlock_wrlock(&rwlock_best_tour);
+  PROF_WAIT(my_rank, "wait rwlock_best_tour", wait_start);
   if (my_best_tour_value < global_best_tour_value)
   {
     free(global_best_tour);
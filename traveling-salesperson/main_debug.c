@@ -6,7 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
-#include "timer.h"
+#include "../common/timer.h"
 #include <limits.h>
 #include <string.h>
 